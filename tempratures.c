@@ -1,19 +1,64 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <ctype.h>
 /*
 *This is a temprature conversion Project
 *To show the skills I have learnt
 *On Varibles and data types
+*The table range can be given as lower:upper:step,
+*for example ./temprature 0:300:20 (the default)
+*Each part must fit in an int and lower cannot be above upper;
+*the table is worked out in long long so the formula cannot overflow.
 */
-int main(void)
+
+/*
+* Reads one int from text, leaving *text just after it.
+* Only digits with an optional '-' are accepted: no spaces or '+'.
+*/
+static int read_part(const char **text, long long *value)
 {
-const int lower = 0;
-const int upper = 300;
-int fahr = lower;
+const char *digits = (**text == '-') ? *text + 1 : *text;
+char *end;
+long number;
+
+if (!isdigit((unsigned char)*digits))
+    return (0);
+errno = 0;
+number = strtol(*text, &end, 10);
+if (end == *text || errno == ERANGE || number < INT_MIN || number > INT_MAX)
+    return (0);
+*value = number;
+*text = end;
+return (1);
+}
+
+int main(int argc, char *argv[])
+{
+long long lower = 0;
+long long upper = 300;
+long long step = 20;
+
+if (argc > 1) {
+    const char *text = argv[1];
+    int ok = read_part(&text, &lower) && *text++ == ':' && read_part(&text, &upper);
+
+    if (ok && *text == ':') {
+        text++;
+        ok = read_part(&text, &step);
+    }
+    if (!ok || *text != '\0' || step <= 0 || lower > upper) {
+        printf("Usage: %s lower:upper[:step]\n", argv[0]);
+        return (1);
+    }
+}
+
+long long fahr = lower;
   while(fahr <= upper)
 {
-const int step = 20;
-int celsius = 5 * (fahr - 32) / 9;
-printf("%d\t%d\n", fahr, celsius);
+long long celsius = 5 * (fahr - 32) / 9;
+printf("%lld\t%lld\n", fahr, celsius);
 fahr += step;
 }
   return (0);
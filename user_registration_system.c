@@ -1,38 +1,1561 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
 /*
 * User Registration System
 * Takes names, age , height and gender
+*
+* Registrations are kept in registrations.txt, one "seq|name|age|height|gender"
+* line each. New records go to the write-ahead log registrations.wal first:
+* records are batched in memory and written with one fsync per batch (a group
+* commit) once the batch is full or its oldest record has waited delay_ms.
+* import waits for input with that deadline, so a slow feed still commits on time.
+* A checkpoint copies the log into registrations.txt and empties it, and the
+* same checkpoint runs on startup to recover anything a crash left in the log.
+* Deleting a user appends a "seq|-deleted_seq" line instead of rewriting the file.
+*
+* Several sessions can register at once: the log is locked only while a batch
+* is committed or checkpointed, and sequence numbers are handed out then.
+*
+* find and fuzzy search names through a trigram index (every three-letter
+* piece of the lowercased name). The index is built once per session, mostly
+* without any lock; only the end of the store and the log are read under a
+* shared lock, which holds off commits for that moment. Before each query
+* the session reads the store and log lines added since, again under the
+* shared lock, so every query sees everything committed before it started.
+*
+* ./registration                          register users one at a time
+* ./registration import <file> [batch] [delay_ms]
+*                                         register "name|age|height|gender" lines
+* ./registration find [text]              names containing text
+* ./registration fuzzy [name] [min_score] names similar to name
+* ./registration delete <id>              delete registration number id
+* ./registration bench <count> [batch]    time group commits of fake records
+* find and fuzzy read one query per line from stdin when none is given.
 */
-int main(void)
+
+#define STORE_FILE "registrations.txt"
+#define WAL_FILE "registrations.wal"
+#define BENCH_STORE_FILE "bench_registrations.txt"
+#define BENCH_WAL_FILE "bench_registrations.wal"
+#define NAME_SIZE 50
+#define RECORD_SIZE 128
+#define DEFAULT_BATCH 64
+#define DEFAULT_DELAY_MS 10
+#define IMPORT_BUFFER 65536
+#define CHECKPOINT_BYTES (1 << 20)
+#define MAX_TRIGRAMS (NAME_SIZE + 3)
+#define MAX_RESULTS 10
+#define FUZZY_THRESHOLD 0.3
+#define FUZZY_BLOCK 16384
+
+struct registration {
+    char name[NAME_SIZE];
+    int age;
+    float height;
+    char gender;
+};
+
+/*
+* Buffered records are kept as '\0'-separated bodies and only get their
+* sequence numbers when committed. data_size and wal_size are the file
+* sizes when last_seq was last worked out.
+*/
+struct store {
+    FILE *data;
+    int wal_fd;
+    const char *data_path;
+    const char *wal_path;
+    int locks;
+    char *pending;
+    size_t pending_len;
+    size_t pending_cap;
+    int pending_count;
+    char *commit_buf;
+    int batch_size;
+    long max_delay_ms;
+    struct timespec first_pending;
+    unsigned long last_seq;
+    off_t data_size;
+    off_t wal_size;
+};
+
+/*
+* Posting lists hold the users whose name contains one trigram, in
+* increasing order, stored as varint-encoded gaps between user numbers.
+*/
+struct posting_list {
+    unsigned int trigram;
+    unsigned int count;
+    unsigned int last_user;
+    unsigned int len;
+    unsigned int cap;
+    unsigned char *bytes;
+};
+
+struct posting_cursor {
+    const unsigned char *next;
+    const unsigned char *end;
+    unsigned int user;
+    unsigned int seen;
+};
+
+/* Buffered reads of import lines that can wait on a commit deadline */
+struct line_reader {
+    int fd;
+    size_t start;
+    size_t end;
+    int eof;
+    int skipping;
+    char buf[IMPORT_BUFFER];
+};
+
+struct indexed_user {
+    unsigned long seq;
+    size_t name;
+    unsigned char grams;
+    unsigned char live;
+};
+
+/* Posting lists sit in an open-addressing table keyed by trigram (0 = empty) */
+struct name_index {
+    struct posting_list *lists;
+    size_t list_cap;
+    unsigned int list_bits;
+    size_t list_count;
+    struct indexed_user *users;
+    size_t user_count;
+    size_t user_cap;
+    char *names;
+    size_t names_len;
+    size_t names_cap;
+};
+
+/* An index kept in step with the store and log between queries */
+struct search_session {
+    struct name_index idx;
+    const char *data_path;
+    const char *wal_path;
+    FILE *data;
+    int wal_fd;
+    long data_offset;
+    long wal_offset;
+    unsigned long wal_first_seq;
+    unsigned long last_seq;
+};
+
+struct match {
+    unsigned int user;
+    double score;
+};
+
+/* FNV-1a, used to spot a log line that was only partly written */
+static unsigned int checksum(const char *text, size_t len)
 {
-char name[50];
-int age;
-float height;
-char gender;
+unsigned int hash = 2166136261u;
 
-printf("====User Registration System=====\n");
+for (size_t i = 0; i < len; i++) {
+    hash ^= (unsigned char)text[i];
+    hash *= 16777619u;
+}
+return (hash);
+}
+
+static double elapsed_ms(const struct timespec *since)
+{
+struct timespec now;
+
+clock_gettime(CLOCK_MONOTONIC, &now);
+return ((now.tv_sec - since->tv_sec) * 1000.0 + (now.tv_nsec - since->tv_nsec) / 1e6);
+}
+
+static int parse_record(const char *line, unsigned long *seq, struct registration *user)
+{
+return (sscanf(line, "%lu|%49[^|]|%d|%f| %c", seq, user->name, &user->age,
+               &user->height, &user->gender) == 5 ? 0 : -1);
+}
+
+static int registration_body(const struct registration *user, char *body, size_t size)
+{
+return (snprintf(body, size, "%s|%d|%.2f|%c", user->name, user->age, user->height, user->gender));
+}
+
+static int parse_tombstone(const char *line, unsigned long *seq, unsigned long *deleted)
+{
+char end;
+
+return (sscanf(line, "%lu|-%lu%c", seq, deleted, &end) == 3 && end == '\n' ? 0 : -1);
+}
+
+static int record_seq(const char *line, unsigned long *seq)
+{
+struct registration user;
+unsigned long deleted;
+
+if (parse_record(line, seq, &user) == 0 || parse_tombstone(line, seq, &deleted) == 0)
+    return (0);
+return (-1);
+}
+
+static int write_all(int fd, const char *buf, size_t len)
+{
+while (len > 0) {
+    ssize_t written = write(fd, buf, len);
+
+    if (written < 0)
+        return (-1);
+    buf += written;
+    len -= (size_t)written;
+}
+return (0);
+}
+
+/* Returns the record part of a log line, or NULL if the line is torn */
+static const char *wal_record(const char *line, unsigned long *seq)
+{
+size_t len = strlen(line);
+unsigned int sum;
+
+if (len < 10 || line[len - 1] != '\n' || sscanf(line, "%8x", &sum) != 1)
+    return (NULL);
+if (checksum(line + 9, len - 10) != sum || record_seq(line + 9, seq) != 0)
+    return (NULL);
+return (line + 9);
+}
+
+/*
+* The log's flock is the writers' lock. It is only held while committing,
+* checkpointing or deleting, never while waiting for input, so several
+* sessions can register at once. Calls nest.
+*/
+static int store_lock(struct store *st)
+{
+if (st->locks++ == 0 && flock(st->wal_fd, LOCK_EX) != 0) {
+    st->locks--;
+    printf("Could not lock %s\n", st->wal_path);
+    return (-1);
+}
+return (0);
+}
+
+static void store_unlock(struct store *st)
+{
+if (--st->locks == 0)
+    flock(st->wal_fd, LOCK_UN);
+}
+
+/*
+* Cuts the store back to its last complete line and returns the sequence
+* number on that line. Half a line is what a crash during a checkpoint
+* leaves behind; the complete record is still in the log.
+* Store lines are appended in sequence order, so only the tail is read.
+*/
+static int store_repair_tail(struct store *st, unsigned long *last_seq)
+{
+char tail[2 * RECORD_SIZE + 1];
+char *line_end = NULL;
+char *line_start;
+long size;
+long from;
+size_t got;
+
+if (fseek(st->data, 0, SEEK_END) != 0 || (size = ftell(st->data)) < 0)
+    return (-1);
+from = size > 2 * RECORD_SIZE ? size - 2 * RECORD_SIZE : 0;
+if (fseek(st->data, from, SEEK_SET) != 0)
+    return (-1);
+got = fread(tail, 1, (size_t)(size - from), st->data);
+tail[got] = '\0';
+for (size_t i = got; i > 0 && line_end == NULL; i--)
+    if (tail[i - 1] == '\n')
+        line_end = &tail[i - 1];
+
+*last_seq = 0;
+if (line_end != NULL) {
+    line_start = line_end;
+    while (line_start > tail && line_start[-1] != '\n')
+        line_start--;
+    line_end[1] = '\0';
+    if (record_seq(line_start, last_seq) != 0)
+        *last_seq = 0;
+}
+if (from + (line_end ? line_end - tail + 1 : 0) < size) {
+    if (ftruncate(fileno(st->data), from + (line_end ? line_end - tail + 1 : 0)) != 0
+        || fsync(fileno(st->data)) != 0) {
+        printf("Could not repair %s\n", st->data_path);
+        return (-1);
+    }
+}
+return (fseek(st->data, 0, SEEK_END));
+}
+
+static void store_remember_sizes(struct store *st)
+{
+struct stat data_stat;
+struct stat wal_stat;
+
+if (fstat(fileno(st->data), &data_stat) == 0 && fstat(st->wal_fd, &wal_stat) == 0) {
+    st->data_size = data_stat.st_size;
+    st->wal_size = wal_stat.st_size;
+} else {
+    st->data_size = -1;
+}
+}
+
+/*
+* Works out the last sequence number in use, with the lock held.
+* If neither file changed since this session last looked, nobody else has
+* written and the number it has is still right. Otherwise the store's last
+* line and the log are read again, and a torn end of the log is cut off so
+* new commits are not appended after it.
+*/
+static int store_sync(struct store *st)
+{
+struct stat data_stat;
+struct stat wal_stat;
+char line[RECORD_SIZE + 16];
+unsigned long last;
+long good_end = 0;
+FILE *wal;
+
+if (fstat(fileno(st->data), &data_stat) != 0 || fstat(st->wal_fd, &wal_stat) != 0)
+    return (-1);
+if (data_stat.st_size == st->data_size && wal_stat.st_size == st->wal_size)
+    return (0);
+
+if (store_repair_tail(st, &last) != 0)
+    return (-1);
+wal = fopen(st->wal_path, "r");
+if (wal == NULL) {
+    printf("Could not read %s\n", st->wal_path);
+    return (-1);
+}
+while (fgets(line, sizeof(line), wal) != NULL) {
+    unsigned long seq;
+
+    if (wal_record(line, &seq) == NULL)
+        break;
+    if (seq > last)
+        last = seq;
+    good_end = ftell(wal);
+}
+fclose(wal);
+if (good_end < wal_stat.st_size && (ftruncate(st->wal_fd, good_end) != 0 || fsync(st->wal_fd) != 0)) {
+    printf("Could not repair %s\n", st->wal_path);
+    return (-1);
+}
+st->last_seq = last;
+store_remember_sizes(st);
+return (0);
+}
+
+static int store_checkpoint(struct store *st);
+
+/*
+* Numbers the buffered records and writes them to the log with a single
+* fsync. Numbers are handed out here, under the lock, so sessions that
+* commit at the same time never reuse one.
+*/
+static int store_commit(struct store *st)
+{
+const char *body = st->pending;
+size_t len = 0;
+int status = 0;
+
+if (st->pending_count == 0)
+    return (0);
+if (store_lock(st) != 0)
+    return (-1);
+if (store_sync(st) != 0) {
+    store_unlock(st);
+    return (-1);
+}
+for (int i = 0; i < st->pending_count; i++) {
+    char record[RECORD_SIZE];
+    int record_len = snprintf(record, sizeof(record), "%lu|%s\n", st->last_seq + i + 1, body);
+
+    /* snprintf also writes a '\0', which the record copied next overwrites */
+    snprintf(st->commit_buf + len, 10, "%08x ", checksum(record, (size_t)record_len - 1));
+    memcpy(st->commit_buf + len + 9, record, (size_t)record_len);
+    len += (size_t)record_len + 9;
+    body += strlen(body) + 1;
+}
+if (write_all(st->wal_fd, st->commit_buf, len) != 0 || fsync(st->wal_fd) != 0) {
+    printf("Could not write %s\n", st->wal_path);
+    st->data_size = -1;
+    status = -1;
+} else {
+    st->last_seq += (unsigned long)st->pending_count;
+    st->wal_size += (off_t)len;
+    st->pending_len = 0;
+    st->pending_count = 0;
+}
+store_unlock(st);
+if (status == 0 && st->wal_size >= CHECKPOINT_BYTES)
+    status = store_checkpoint(st);
+return (status);
+}
+
+/*
+* Copies committed log records into the store and empties the log.
+* Records carry sequence numbers, so replaying a log that was already
+* copied before a crash does not add them twice.
+* Reading stops at the first line with a bad checksum: that is where
+* the last write was cut off.
+*/
+static int store_fold_log(struct store *st)
+{
+FILE *wal;
+char line[RECORD_SIZE + 16];
+unsigned long last;
+
+if (store_repair_tail(st, &last) != 0)
+    return (-1);
+wal = fopen(st->wal_path, "r");
+if (wal == NULL) {
+    printf("Could not read %s\n", st->wal_path);
+    return (-1);
+}
+while (fgets(line, sizeof(line), wal) != NULL) {
+    unsigned long seq;
+    const char *record = wal_record(line, &seq);
+
+    if (record == NULL)
+        break;
+    if (seq <= last)
+        continue;
+    fputs(record, st->data);
+    last = seq;
+}
+fclose(wal);
+
+if (fflush(st->data) != 0 || fsync(fileno(st->data)) != 0) {
+    printf("Could not write %s\n", st->data_path);
+    return (-1);
+}
+if (ftruncate(st->wal_fd, 0) != 0 || fsync(st->wal_fd) != 0) {
+    printf("Could not reset %s\n", st->wal_path);
+    return (-1);
+}
+st->last_seq = last;
+store_remember_sizes(st);
+return (0);
+}
+
+static int store_checkpoint(struct store *st)
+{
+int status;
+
+if (store_commit(st) != 0 || store_lock(st) != 0)
+    return (-1);
+status = store_fold_log(st);
+store_unlock(st);
+return (status);
+}
+
+static int store_open(struct store *st, const char *data_path, const char *wal_path,
+                      int batch_size, long max_delay_ms)
+{
+memset(st, 0, sizeof(*st));
+st->data_path = data_path;
+st->wal_path = wal_path;
+st->batch_size = batch_size > 0 ? batch_size : 1;
+st->max_delay_ms = max_delay_ms;
+st->data_size = -1;
+
+st->data = fopen(data_path, "a+");
+if (st->data == NULL) {
+    printf("Could not open %s\n", data_path);
+    return (-1);
+}
+st->wal_fd = open(wal_path, O_RDWR | O_CREAT | O_APPEND, 0644);
+if (st->wal_fd < 0) {
+    printf("Could not open %s\n", wal_path);
+    fclose(st->data);
+    return (-1);
+}
+if (store_checkpoint(st) != 0) {
+    close(st->wal_fd);
+    fclose(st->data);
+    return (-1);
+}
+return (0);
+}
+
+/* Buffers one record; it is durable once the batch it belongs to commits */
+static int store_append(struct store *st, const char *body)
+{
+size_t len = strlen(body) + 1;
+
+/* Leave room for the sequence number and newline added at commit */
+if (len + 22 > RECORD_SIZE)
+    return (-1);
+if (st->pending_len + len > st->pending_cap) {
+    size_t cap = st->pending_cap ? st->pending_cap * 2 : 4096;
+    char *grown;
+    char *grown_commit;
+
+    grown = realloc(st->pending, cap);
+    if (grown == NULL) {
+        printf("Out of memory\n");
+        return (-1);
+    }
+    st->pending = grown;
+    /* Numbering adds at most 30 bytes to a body of at least 3 */
+    grown_commit = realloc(st->commit_buf, cap * 11);
+    if (grown_commit == NULL) {
+        printf("Out of memory\n");
+        return (-1);
+    }
+    st->commit_buf = grown_commit;
+    st->pending_cap = cap;
+}
+if (st->pending_count == 0)
+    clock_gettime(CLOCK_MONOTONIC, &st->first_pending);
+memcpy(st->pending + st->pending_len, body, len);
+st->pending_len += len;
+st->pending_count++;
+
+if (st->pending_count >= st->batch_size || elapsed_ms(&st->first_pending) >= st->max_delay_ms)
+    return (store_commit(st));
+return (0);
+}
+
+/* Milliseconds until the buffered batch is due, or -1 when nothing is buffered */
+static int store_wait_ms(const struct store *st)
+{
+double left;
+
+if (st->pending_count == 0)
+    return (-1);
+left = st->max_delay_ms - elapsed_ms(&st->first_pending);
+return (left > 0 ? (int)left + 1 : 0);
+}
+
+static int store_add(struct store *st, const struct registration *user)
+{
+char body[RECORD_SIZE];
+int len;
+
+len = registration_body(user, body, sizeof(body));
+if (len < 0 || len >= (int)sizeof(body))
+    return (-1);
+return (store_append(st, body));
+}
+
+static int store_delete(struct store *st, unsigned long seq)
+{
+char body[32];
+
+snprintf(body, sizeof(body), "-%lu", seq);
+return (store_append(st, body));
+}
+
+static int store_close(struct store *st)
+{
+int status = store_checkpoint(st);
+
+free(st->pending);
+free(st->commit_buf);
+close(st->wal_fd);
+if (fclose(st->data) != 0)
+    status = -1;
+return (status);
+}
+
+static int compare_uint(const void *a, const void *b)
+{
+unsigned int x = *(const unsigned int *)a;
+unsigned int y = *(const unsigned int *)b;
+
+return ((x > y) - (x < y));
+}
+
+/*
+* Sorted, duplicate-free trigrams of the lowercased text.
+* The index stores padded trigrams ("  a", " ad", ... "da "), which give
+* word starts and ends extra weight when scoring. Substring queries use
+* unpadded ones because the text may begin in the middle of a name.
+*/
+static size_t name_trigrams(const char *text, int padded, unsigned int *out)
+{
+unsigned char buf[NAME_SIZE + 3];
+size_t len = 0;
+size_t count = 0;
+size_t unique = 0;
+
+if (padded) {
+    buf[len++] = ' ';
+    buf[len++] = ' ';
+}
+for (; *text != '\0' && len < NAME_SIZE + 1; text++)
+    buf[len++] = (unsigned char)tolower((unsigned char)*text);
+if (padded)
+    buf[len++] = ' ';
+
+for (size_t i = 0; i + 3 <= len; i++)
+    out[count++] = ((unsigned int)buf[i] << 16) | ((unsigned int)buf[i + 1] << 8) | buf[i + 2];
+qsort(out, count, sizeof(*out), compare_uint);
+for (size_t i = 0; i < count; i++)
+    if (unique == 0 || out[unique - 1] != out[i])
+        out[unique++] = out[i];
+return (unique);
+}
+
+/*
+* Multiplicative hashing: the top bits of the product depend on all three
+* characters, the low bits would ignore the first one.
+*/
+static size_t trigram_slot(unsigned int trigram, unsigned int bits)
+{
+return ((unsigned int)(trigram * 2654435761u) >> (32 - bits));
+}
+
+static const struct posting_list *index_list(const struct name_index *idx, unsigned int trigram)
+{
+if (idx->list_cap == 0)
+    return (NULL);
+for (size_t slot = trigram_slot(trigram, idx->list_bits);
+     idx->lists[slot].trigram != 0; slot = (slot + 1) & (idx->list_cap - 1))
+    if (idx->lists[slot].trigram == trigram)
+        return (&idx->lists[slot]);
+return (NULL);
+}
+
+static int index_grow(struct name_index *idx)
+{
+unsigned int bits = idx->list_bits ? idx->list_bits + 1 : 10;
+size_t cap = (size_t)1 << bits;
+struct posting_list *lists = calloc(cap, sizeof(*lists));
+
+if (lists == NULL)
+    return (-1);
+for (size_t i = 0; i < idx->list_cap; i++) {
+    size_t slot;
+
+    if (idx->lists[i].trigram == 0)
+        continue;
+    slot = trigram_slot(idx->lists[i].trigram, bits);
+    while (lists[slot].trigram != 0)
+        slot = (slot + 1) & (cap - 1);
+    lists[slot] = idx->lists[i];
+}
+free(idx->lists);
+idx->lists = lists;
+idx->list_cap = cap;
+idx->list_bits = bits;
+return (0);
+}
+
+static struct posting_list *index_list_add(struct name_index *idx, unsigned int trigram)
+{
+size_t slot;
+
+if ((idx->list_count + 1) * 4 > idx->list_cap * 3 && index_grow(idx) != 0)
+    return (NULL);
+slot = trigram_slot(trigram, idx->list_bits);
+while (idx->lists[slot].trigram != 0 && idx->lists[slot].trigram != trigram)
+    slot = (slot + 1) & (idx->list_cap - 1);
+if (idx->lists[slot].trigram == 0) {
+    idx->lists[slot].trigram = trigram;
+    idx->list_count++;
+}
+return (&idx->lists[slot]);
+}
+
+static int posting_add(struct posting_list *list, unsigned int user)
+{
+unsigned int gap = list->count ? user - list->last_user : user;
+
+if (list->len + 5 > list->cap) {
+    unsigned int cap = list->cap ? list->cap * 2 : 8;
+    unsigned char *grown = realloc(list->bytes, cap);
+
+    if (grown == NULL)
+        return (-1);
+    list->bytes = grown;
+    list->cap = cap;
+}
+while (gap >= 0x80) {
+    list->bytes[list->len++] = (unsigned char)(gap | 0x80);
+    gap >>= 7;
+}
+list->bytes[list->len++] = (unsigned char)gap;
+list->last_user = user;
+list->count++;
+return (0);
+}
+
+static void cursor_open(struct posting_cursor *cur, const struct posting_list *list)
+{
+cur->next = list->bytes;
+cur->end = list->bytes + list->len;
+cur->user = 0;
+cur->seen = 0;
+}
+
+static int cursor_next(struct posting_cursor *cur)
+{
+unsigned int gap = 0;
+int shift = 0;
+
+if (cur->next >= cur->end)
+    return (0);
+do {
+    gap |= (unsigned int)(*cur->next & 0x7f) << shift;
+    shift += 7;
+} while (*cur->next++ & 0x80);
+cur->user = cur->seen++ ? cur->user + gap : gap;
+return (1);
+}
 
+static const char *index_name(const struct name_index *idx, size_t user)
+{
+return (idx->names + idx->users[user].name);
+}
+
+static int index_insert(struct name_index *idx, unsigned long seq, const char *name)
+{
+unsigned int grams[MAX_TRIGRAMS];
+size_t count = name_trigrams(name, 1, grams);
+size_t len = strlen(name) + 1;
+unsigned int user = (unsigned int)idx->user_count;
+
+if (idx->user_count == idx->user_cap) {
+    size_t cap = idx->user_cap ? idx->user_cap * 2 : 1024;
+    struct indexed_user *grown = realloc(idx->users, cap * sizeof(*grown));
+
+    if (grown == NULL)
+        return (-1);
+    idx->users = grown;
+    idx->user_cap = cap;
+}
+if (idx->names_len + len > idx->names_cap) {
+    size_t cap = idx->names_cap ? idx->names_cap * 2 : 65536;
+    char *grown;
+
+    while (cap < idx->names_len + len)
+        cap *= 2;
+    grown = realloc(idx->names, cap);
+    if (grown == NULL)
+        return (-1);
+    idx->names = grown;
+    idx->names_cap = cap;
+}
+memcpy(idx->names + idx->names_len, name, len);
+idx->users[user].seq = seq;
+idx->users[user].name = idx->names_len;
+idx->users[user].grams = (unsigned char)count;
+idx->users[user].live = 1;
+idx->names_len += len;
+idx->user_count++;
+
+for (size_t i = 0; i < count; i++) {
+    struct posting_list *list = index_list_add(idx, grams[i]);
+
+    if (list == NULL || posting_add(list, user) != 0)
+        return (-1);
+}
+return (0);
+}
+
+/* Users are added in registration order, so seq can be binary searched */
+static long index_find(const struct name_index *idx, unsigned long seq)
+{
+size_t low = 0;
+size_t high = idx->user_count;
+
+while (low < high) {
+    size_t mid = low + (high - low) / 2;
+
+    if (idx->users[mid].seq < seq)
+        low = mid + 1;
+    else
+        high = mid;
+}
+if (low < idx->user_count && idx->users[low].seq == seq && idx->users[low].live)
+    return ((long)low);
+return (-1);
+}
+
+/* Deleted users stay in the posting lists and are skipped when searching */
+static void index_remove(struct name_index *idx, unsigned long seq)
+{
+long user = index_find(idx, seq);
+
+if (user >= 0)
+    idx->users[user].live = 0;
+}
+
+/*
+* Applies one store or log line to the index, keeping *last at its seq.
+* Only the seq and name are needed, so a registration is not parsed in
+* full: loading the index is mostly spent here.
+*/
+static int index_apply(struct name_index *idx, const char *line, unsigned long *last)
+{
+char name[NAME_SIZE];
+char *rest;
+unsigned long seq = strtoul(line, &rest, 10);
+unsigned long deleted;
+size_t len;
+
+if (rest == line || rest[0] != '|')
+    return (0);
+len = strcspn(rest + 1, "|");
+/* A name may start with '-' too, but then the line goes on after it */
+if (rest[1] == '-' && parse_tombstone(line, &seq, &deleted) == 0) {
+    if (seq > *last)
+        index_remove(idx, deleted);
+} else if (len > 0 && len < NAME_SIZE && rest[1 + len] == '|') {
+    memcpy(name, rest + 1, len);
+    name[len] = '\0';
+    if (seq > *last && index_insert(idx, seq, name) != 0) {
+        printf("Out of memory while indexing names\n");
+        return (-1);
+    }
+} else {
+    return (0);
+}
+if (seq > *last)
+    *last = seq;
+return (0);
+}
+
+/*
+* Reads complete store lines from offset on and returns the offset after
+* the last one, or -1. A line without its newline is still being written
+* (or was torn by a crash) and is left for later.
+*/
+static long index_read_store(struct name_index *idx, FILE *data, long offset, unsigned long *last)
+{
+char line[RECORD_SIZE];
+
+if (fseek(data, offset, SEEK_SET) != 0)
+    return (-1);
+while (fgets(line, sizeof(line), data) != NULL) {
+    size_t len = strlen(line);
+
+    if (len == 0 || line[len - 1] != '\n')
+        break;
+    if (index_apply(idx, line, last) != 0)
+        return (-1);
+    offset = ftell(data);
+}
+return (offset);
+}
+
+/* Applies the complete log lines from wal_offset on, then remembers where they end */
+static int session_read_log(struct search_session *ss)
+{
+FILE *wal = fopen(ss->wal_path, "r");
+char line[RECORD_SIZE + 16];
+unsigned long seq;
+int status = 0;
+
+if (wal == NULL)
+    return (0);
+/* A checkpoint empties the log, and the next commit starts it with a new seq */
+if (fgets(line, sizeof(line), wal) == NULL || wal_record(line, &seq) == NULL) {
+    ss->wal_offset = 0;
+    ss->wal_first_seq = 0;
+    fclose(wal);
+    return (0);
+}
+if (seq != ss->wal_first_seq) {
+    ss->wal_offset = 0;
+    ss->wal_first_seq = seq;
+}
+if (fseek(wal, ss->wal_offset, SEEK_SET) != 0)
+    status = -1;
+while (status == 0 && fgets(line, sizeof(line), wal) != NULL) {
+    const char *record = wal_record(line, &seq);
+
+    if (record == NULL)
+        break;
+    status = index_apply(&ss->idx, record, &ss->last_seq);
+    ss->wal_offset = ftell(wal);
+}
+fclose(wal);
+return (status);
+}
+
+/*
+* Reads what was committed since the last refresh: new store lines first,
+* then the log. Both are read under a shared lock on the log, so no commit
+* or checkpoint moves records between them halfway through.
+*/
+static int session_refresh(struct search_session *ss)
+{
+long offset = ss->data_offset;
+int status;
+
+if (ss->data == NULL)
+    ss->data = fopen(ss->data_path, "r");
+if (ss->wal_fd < 0)
+    ss->wal_fd = open(ss->wal_path, O_RDONLY);
+if (ss->wal_fd >= 0 && flock(ss->wal_fd, LOCK_SH) != 0) {
+    printf("Could not lock %s\n", ss->wal_path);
+    return (-1);
+}
+if (ss->data != NULL)
+    offset = index_read_store(&ss->idx, ss->data, ss->data_offset, &ss->last_seq);
+status = offset < 0 ? -1 : 0;
+if (status == 0) {
+    ss->data_offset = offset;
+    if (ss->wal_fd >= 0)
+        status = session_read_log(ss);
+}
+if (ss->wal_fd >= 0)
+    flock(ss->wal_fd, LOCK_UN);
+return (status);
+}
+
+/*
+* Builds the index from a read-only view of the store and the log.
+* The bulk of the store is read without any lock, so writers only wait
+* while the refresh reads the lines added since and the log.
+*/
+static int session_open(struct search_session *ss, const char *data_path, const char *wal_path)
+{
+struct timespec start;
+
+clock_gettime(CLOCK_MONOTONIC, &start);
+memset(ss, 0, sizeof(*ss));
+ss->data_path = data_path;
+ss->wal_path = wal_path;
+ss->wal_fd = -1;
+ss->data = fopen(data_path, "r");
+if (ss->data != NULL) {
+    ss->data_offset = index_read_store(&ss->idx, ss->data, 0, &ss->last_seq);
+    if (ss->data_offset < 0)
+        return (-1);
+}
+if (session_refresh(ss) != 0)
+    return (-1);
+printf("Indexed %zu names in %.2f ms\n", ss->idx.user_count, elapsed_ms(&start));
+return (0);
+}
+
+static void index_free(struct name_index *idx)
+{
+for (size_t i = 0; i < idx->list_cap; i++)
+    free(idx->lists[i].bytes);
+free(idx->lists);
+free(idx->users);
+free(idx->names);
+}
+
+static void session_close(struct search_session *ss)
+{
+index_free(&ss->idx);
+if (ss->data != NULL)
+    fclose(ss->data);
+if (ss->wal_fd >= 0)
+    close(ss->wal_fd);
+}
+
+static int compare_lists(const void *a, const void *b)
+{
+const struct posting_list *x = *(const struct posting_list *const *)a;
+const struct posting_list *y = *(const struct posting_list *const *)b;
+unsigned int cx = x ? x->count : 0;
+unsigned int cy = y ? y->count : 0;
+
+return ((cx > cy) - (cx < cy));
+}
+
+/*
+* Users whose names contain every trigram of the query.
+* Lists are intersected smallest first, so the candidate set starts
+* small and the longer lists are only walked as far as it reaches.
+*/
+static size_t substring_candidates(const struct name_index *idx, const char *query, unsigned int **out)
+{
+unsigned int grams[MAX_TRIGRAMS];
+const struct posting_list *lists[MAX_TRIGRAMS];
+size_t count = name_trigrams(query, 0, grams);
+size_t found = 0;
+struct posting_cursor cur;
+unsigned int *cand;
+
+/* Too short for a trigram: every user is a candidate */
+if (count == 0) {
+    cand = malloc((idx->user_count + 1) * sizeof(*cand));
+    if (cand == NULL)
+        return (0);
+    for (size_t i = 0; i < idx->user_count; i++)
+        cand[i] = (unsigned int)i;
+    *out = cand;
+    return (idx->user_count);
+}
+for (size_t i = 0; i < count; i++) {
+    lists[i] = index_list(idx, grams[i]);
+    if (lists[i] == NULL)
+        return (0);
+}
+qsort(lists, count, sizeof(*lists), compare_lists);
+
+cand = malloc(lists[0]->count * sizeof(*cand));
+if (cand == NULL)
+    return (0);
+cursor_open(&cur, lists[0]);
+while (cursor_next(&cur))
+    cand[found++] = cur.user;
+
+for (size_t i = 1; i < count && found > 0; i++) {
+    size_t kept = 0;
+    int more;
+
+    cursor_open(&cur, lists[i]);
+    more = cursor_next(&cur);
+    for (size_t j = 0; j < found && more; j++) {
+        while (more && cur.user < cand[j])
+            more = cursor_next(&cur);
+        if (more && cur.user == cand[j])
+            cand[kept++] = cand[j];
+    }
+    found = kept;
+}
+*out = cand;
+return (found);
+}
+
+/*
+* Users sharing at least need of the query's count trigrams, with how many
+* each shares in *hits. All the lists are walked together, FUZZY_BLOCK users
+* at a time, so the hit counts for a block stay in the cache. Lists are taken
+* shortest first. A user sharing need trigrams is in one of the first
+* count - need + 1 of them, so the longer lists only add to users already
+* seen. need 0 takes every user.
+*/
+static size_t fuzzy_candidates(const struct name_index *idx, const unsigned int *grams,
+                               size_t count, size_t need, unsigned int **out,
+                               unsigned char **hits_out)
+{
+const struct posting_list *lists[MAX_TRIGRAMS];
+struct posting_cursor cur[MAX_TRIGRAMS];
+int more[MAX_TRIGRAMS];
+unsigned char counts[FUZZY_BLOCK];
+size_t probe;
+size_t total = 0;
+size_t found = 0;
+unsigned int *cand;
+unsigned char *hits;
+
+if (need > count)
+    return (0);
+probe = count - need + 1;
+for (size_t i = 0; i < count; i++) {
+    lists[i] = index_list(idx, grams[i]);
+    if (lists[i] != NULL)
+        total += lists[i]->count;
+}
+qsort(lists, count, sizeof(*lists), compare_lists);
+
+/* Every candidate has need hits, so there are at most total / need */
+total = need == 0 ? idx->user_count : total / need;
+cand = malloc((total + 1) * sizeof(*cand));
+hits = malloc(total + 1);
+if (cand == NULL || hits == NULL) {
+    free(cand);
+    free(hits);
+    return (0);
+}
+for (size_t i = 0; i < count; i++) {
+    more[i] = 0;
+    if (lists[i] != NULL) {
+        cursor_open(&cur[i], lists[i]);
+        more[i] = cursor_next(&cur[i]);
+    }
+}
+for (size_t base = 0; base < idx->user_count; base += FUZZY_BLOCK) {
+    size_t limit = base + FUZZY_BLOCK;
+    size_t first = found;
+
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < count; i++) {
+        /* A local copy, as writes through counts could otherwise touch cur[i] */
+        struct posting_cursor list = cur[i];
+        int going = more[i];
+
+        for (; going && list.user < limit; going = cursor_next(&list)) {
+            unsigned char *hit = &counts[list.user - base];
+
+            if (i >= probe && *hit == 0)
+                continue;
+            if (++*hit == need)
+                cand[found++] = list.user;
+        }
+        cur[i] = list;
+        more[i] = going;
+    }
+    if (need == 0)
+        for (size_t user = base; user < limit && user < idx->user_count; user++)
+            cand[found++] = (unsigned int)user;
+    for (size_t i = first; i < found; i++)
+        hits[i] = counts[cand[i] - base];
+}
+*out = cand;
+*hits_out = hits;
+return (found);
+}
+
+/* Share of trigrams the two names have in common (Jaccard similarity) */
+static double name_similarity(const char *name, const unsigned int *grams, size_t count)
+{
+unsigned int own[MAX_TRIGRAMS];
+size_t own_count = name_trigrams(name, 1, own);
+size_t shared = 0;
+size_t i = 0;
+size_t j = 0;
+
+while (i < count && j < own_count) {
+    if (grams[i] == own[j]) {
+        shared++;
+        i++;
+        j++;
+    } else if (grams[i] < own[j]) {
+        i++;
+    } else {
+        j++;
+    }
+}
+return (count + own_count > 0 ? (double)shared / (double)(count + own_count - shared) : 0.0);
+}
+
+static int contains_text(const char *name, const char *lowered_query)
+{
+char lowered[NAME_SIZE];
+size_t i;
+
+for (i = 0; name[i] != '\0' && i < NAME_SIZE - 1; i++)
+    lowered[i] = (char)tolower((unsigned char)name[i]);
+lowered[i] = '\0';
+return (strstr(lowered, lowered_query) != NULL);
+}
+
+static int compare_matches(const void *a, const void *b)
+{
+const struct match *x = a;
+const struct match *y = b;
+
+if (x->score != y->score)
+    return (x->score < y->score ? 1 : -1);
+return ((x->user > y->user) - (x->user < y->user));
+}
+
+/* start is when the query arrived, so the time includes catching up with the store */
+static void index_search(const struct name_index *idx, const char *query, int fuzzy, double min_score,
+                         const struct timespec *start)
+{
+unsigned int grams[MAX_TRIGRAMS];
+size_t count = name_trigrams(query, 1, grams);
+char lowered[NAME_SIZE];
+unsigned int *cand = NULL;
+unsigned char *hits = NULL;
+struct match *matches;
+size_t found;
+size_t need = (size_t)(min_score * count);
+size_t match_count = 0;
+size_t i;
+
+for (i = 0; query[i] != '\0' && i < NAME_SIZE - 1; i++)
+    lowered[i] = (char)tolower((unsigned char)query[i]);
+lowered[i] = '\0';
+
+/* A name scoring min_score shares at least min_score * count trigrams */
+if (need < min_score * count)
+    need++;
+if (fuzzy)
+    found = fuzzy_candidates(idx, grams, count, need, &cand, &hits);
+else
+    found = substring_candidates(idx, lowered, &cand);
+matches = malloc((found + 1) * sizeof(*matches));
+if (matches == NULL) {
+    free(cand);
+    free(hits);
+    printf("Out of memory\n");
+    return;
+}
+for (i = 0; i < found; i++) {
+    const char *name = index_name(idx, cand[i]);
+    double score;
+
+    if (!idx->users[cand[i]].live)
+        continue;
+    if (fuzzy) {
+        /* Trigrams are unique on both sides, so hits is the overlap */
+        score = (double)hits[i] / (double)(count + idx->users[cand[i]].grams - hits[i]);
+        if (score < min_score)
+            continue;
+    } else {
+        if (!contains_text(name, lowered))
+            continue;
+        score = name_similarity(name, grams, count);
+    }
+    matches[match_count].user = cand[i];
+    matches[match_count].score = score;
+    match_count++;
+}
+qsort(matches, match_count, sizeof(*matches), compare_matches);
+
+for (i = 0; i < match_count && i < MAX_RESULTS; i++)
+    printf("#%lu %s (%.2f)\n", idx->users[matches[i].user].seq,
+           index_name(idx, matches[i].user), matches[i].score);
+printf("%zu matches for \"%s\" in %.2f ms\n", match_count, query, elapsed_ms(start));
+free(matches);
+free(hits);
+free(cand);
+}
+
+static int valid_registration(struct registration *user)
+{
+char body[RECORD_SIZE];
+int len;
+
+user->gender = (char)toupper((unsigned char)user->gender);
+if (user->name[0] == '\0' || strchr(user->name, '|') != NULL) {
+    printf("Names cannot be empty or contain '|'\n");
+    return (0);
+}
+if (user->gender != 'M' && user->gender != 'F') {
+    printf("Please state sex as M or F\n");
+    return (0);
+}
+/* Leave room for the sequence number added at commit, as store_append does */
+len = registration_body(user, body, sizeof(body));
+if (len < 0 || (size_t)len + 23 > RECORD_SIZE) {
+    printf("These details are too long to save\n");
+    return (0);
+}
+return (1);
+}
+
+/*
+* Copies the next line (without its '\n') into line and returns 1,
+* or returns 0 at end of input and -2 on a read error.
+* With timeout_ms >= 0 it waits at most that long for more input and
+* returns -1 if no complete line is ready yet.
+* Lines that do not fit are handed back empty so the caller skips them.
+*/
+static int read_line(struct line_reader *reader, char *line, size_t cap, int timeout_ms)
+{
+for (;;) {
+    char *from = reader->buf + reader->start;
+    size_t avail = reader->end - reader->start;
+    char *newline = memchr(from, '\n', avail);
+    ssize_t got;
+
+    if (newline != NULL || (reader->eof && avail > 0)) {
+        size_t len = newline ? (size_t)(newline - from) : avail;
+
+        if (reader->skipping || len >= cap)
+            len = 0;
+        memcpy(line, from, len);
+        line[len] = '\0';
+        reader->start += newline ? (size_t)(newline - from) + 1 : avail;
+        reader->skipping = 0;
+        return (1);
+    }
+    if (reader->eof)
+        return (0);
+
+    if (reader->start > 0) {
+        memmove(reader->buf, from, avail);
+        reader->start = 0;
+        reader->end = avail;
+    }
+    if (reader->end == sizeof(reader->buf)) {
+        reader->skipping = 1;
+        reader->end = 0;
+    }
+    if (timeout_ms >= 0) {
+        struct pollfd ready = {reader->fd, POLLIN, 0};
+        int polled = poll(&ready, 1, timeout_ms);
+
+        if (polled < 0 && errno != EINTR)
+            return (-2);
+        if (polled <= 0)
+            return (-1);
+    }
+    got = read(reader->fd, reader->buf + reader->end, sizeof(reader->buf) - reader->end);
+    if (got < 0 && errno != EINTR)
+        return (-2);
+    if (got == 0)
+        reader->eof = 1;
+    else if (got > 0)
+        reader->end += (size_t)got;
+    if (timeout_ms >= 0 && memchr(reader->buf + reader->start, '\n', reader->end - reader->start) == NULL
+        && !reader->eof)
+        return (-1);
+}
+}
+
+static int import_registrations(struct store *st, const char *path)
+{
+struct line_reader *reader = calloc(1, sizeof(*reader));
+char line[RECORD_SIZE];
+struct timespec start;
+long count = 0;
+int status = 0;
+
+if (reader == NULL) {
+    printf("Out of memory\n");
+    return (-1);
+}
+reader->fd = open(path, O_RDONLY);
+if (reader->fd < 0) {
+    printf("Could not open %s\n", path);
+    free(reader);
+    return (-1);
+}
+clock_gettime(CLOCK_MONOTONIC, &start);
+for (;;) {
+    struct registration user;
+    int got = read_line(reader, line, sizeof(line), store_wait_ms(st));
+
+    /* Nothing new before the batch is due: commit what is buffered */
+    if (got == -1) {
+        if (store_wait_ms(st) == 0 && store_commit(st) != 0) {
+            status = -1;
+            break;
+        }
+        continue;
+    }
+    if (got == 0)
+        break;
+    if (got < 0) {
+        printf("Could not read %s\n", path);
+        status = -1;
+        break;
+    }
+    if (sscanf(line, "%49[^|]|%d|%f| %c", user.name, &user.age, &user.height, &user.gender) != 4
+        || !valid_registration(&user)) {
+        printf("Skipping line: %s\n", line);
+        continue;
+    }
+    if (store_add(st, &user) != 0) {
+        printf("Could not save line: %s\n", line);
+        status = -1;
+        break;
+    }
+    count++;
+}
+close(reader->fd);
+free(reader);
+if (status != 0 || store_commit(st) != 0)
+    return (-1);
+printf("Registered %ld users in %.1f ms\n", count, elapsed_ms(&start));
+return (0);
+}
+
+static int bench_registrations(long count, int batch_size)
+{
+struct store st;
+struct registration user = {"Bench User", 30, 170.0f, 'F'};
+struct timespec start;
+double ms;
+int status = 0;
+
+remove(BENCH_STORE_FILE);
+remove(BENCH_WAL_FILE);
+if (store_open(&st, BENCH_STORE_FILE, BENCH_WAL_FILE, batch_size, DEFAULT_DELAY_MS) != 0)
+    return (1);
+clock_gettime(CLOCK_MONOTONIC, &start);
+for (long i = 0; i < count && status == 0; i++)
+    status = store_add(&st, &user);
+if (status == 0)
+    status = store_commit(&st);
+ms = elapsed_ms(&start);
+if (store_close(&st) != 0)
+    status = -1;
+remove(BENCH_STORE_FILE);
+remove(BENCH_WAL_FILE);
+if (status != 0)
+    return (1);
+
+printf("batch %d: %ld registrations in %.1f ms (%.0f per second)\n",
+       batch_size, count, ms, count / (ms / 1000.0));
+return (0);
+}
+
+/*
+* Deletes under the writers' lock: the log is folded into the store first,
+* so one read of the store shows whether the registration is still live.
+*/
+static int delete_registration(struct store *st, unsigned long seq)
+{
+char line[RECORD_SIZE];
+char name[NAME_SIZE] = "";
+int live = 0;
+int status;
+
+if (store_lock(st) != 0)
+    return (-1);
+if (store_checkpoint(st) != 0) {
+    store_unlock(st);
+    return (-1);
+}
+rewind(st->data);
+while (fgets(line, sizeof(line), st->data) != NULL) {
+    char *rest;
+    unsigned long line_seq = strtoul(line, &rest, 10);
+    unsigned long deleted;
+    struct registration user;
+
+    /* Only the matching line is parsed in full, a name may start with '-' */
+    if (line_seq == seq && parse_record(line, &line_seq, &user) == 0) {
+        live = 1;
+        strcpy(name, user.name);
+    } else if (rest[0] == '|' && rest[1] == '-') {
+        if (parse_tombstone(line, &line_seq, &deleted) == 0 && deleted == seq)
+            live = 0;
+    }
+}
+if (!live) {
+    printf("There is no registration #%lu\n", seq);
+    store_unlock(st);
+    return (-1);
+}
+status = (store_delete(st, seq) == 0 && store_commit(st) == 0) ? 0 : -1;
+store_unlock(st);
+if (status == 0)
+    printf("Deleted #%lu %s\n", seq, name);
+return (status);
+}
+
+static int search_registrations(struct search_session *ss, int argc, char *argv[], int fuzzy)
+{
+double min_score = FUZZY_THRESHOLD;
+char query[RECORD_SIZE];
+struct timespec start;
+
+if (fuzzy && argc > 3) {
+    char *end;
+
+    min_score = strtod(argv[3], &end);
+    /* Written this way round so that nan fails too */
+    if (end == argv[3] || *end != '\0' || !(min_score >= 0.0 && min_score <= 1.0)) {
+        printf("Usage: %s fuzzy [name] [min_score from 0 to 1]\n", argv[0]);
+        return (-1);
+    }
+}
+if (session_open(ss, STORE_FILE, WAL_FILE) != 0)
+    return (-1);
+if (argc > 2) {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    index_search(&ss->idx, argv[2], fuzzy, min_score, &start);
+    return (0);
+}
+while (fgets(query, sizeof(query), stdin) != NULL) {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    query[strcspn(query, "\n")] = '\0';
+    if (query[0] == '\0')
+        continue;
+    if (session_refresh(ss) != 0)
+        return (-1);
+    index_search(&ss->idx, query, fuzzy, min_score, &start);
+}
+return (0);
+}
+
+static int register_users(struct store *st)
+{
+struct registration user;
+char again = 'N';
+int ok;
+
+printf("====User Registration System=====\n");
+do {
+memset(&user, 0, sizeof(user));
 printf("What is your name? \n");
-scanf(" %[^\n]", name);
+ok = scanf(" %49[^\n]", user.name) == 1;
 
-printf("How old are you? \n");
-scanf("%d", &age);
+if (ok) {
+    printf("How old are you? \n");
+    ok = scanf("%d", &user.age) == 1;
+}
+if (ok) {
+    printf("Please state your height in centimeters: \n");
+    ok = scanf("%f", &user.height) == 1;
+}
+if (ok) {
+    printf("Please state sex given at birth M/F?\n");
+    ok = scanf(" %c", &user.gender) == 1;
+}
 
-printf("Please state your height in centimeters: \n");
-scanf("%f", &height);
+if (!ok) {
+    int c;
 
-printf("Please state sex given at birth M/F?\n");
-scanf(" %c", &gender);
+    if (feof(stdin))
+        break;
+    printf("Invalid input, this registration was not saved\n");
+    while ((c = getchar()) != '\n' && c != EOF);
+} else if (valid_registration(&user)) {
+    /* Someone is waiting on the answer, so commit right away */
+    if (store_add(st, &user) != 0 || store_commit(st) != 0) {
+        printf("Could not save this registration\n");
+        return (-1);
+    }
 
+    printf("====User Details=====\n");
+    printf("My name is %s\n", user.name);
+    printf("I'm %d years old. \n", user.age);
+    printf("My height is %.2f centimeters.\n", user.height);
+    printf("My gender is %c by birth.\n", user.gender);
+}
 
-printf("====User Details=====\n");
-printf("My name is %s\n", name);
-printf("I/'m %d years old. \n", age);
-printf("My height is %.2f centimeters.\n", height);
-printf("My gender is %c by birth.\n", gender);
+printf("Register another user? Y/N\n");
+if (scanf(" %c", &again) != 1)
+    again = 'N';
+} while (again == 'Y' || again == 'y');
+return (0);
+}
 
-return(0);
+int main(int argc, char *argv[])
+{
+struct store st;
+int importing = argc > 2 && strcmp(argv[1], "import") == 0;
+int status;
+
+if (argc > 2 && strcmp(argv[1], "bench") == 0)
+    return (bench_registrations(atol(argv[2]), argc > 3 ? atoi(argv[3]) : DEFAULT_BATCH));
 
+/* Searches only read, so they never open the store for writing */
+if (argc > 1 && (strcmp(argv[1], "find") == 0 || strcmp(argv[1], "fuzzy") == 0)) {
+    struct search_session ss;
 
+    memset(&ss, 0, sizeof(ss));
+    ss.wal_fd = -1;
+    status = search_registrations(&ss, argc, argv, strcmp(argv[1], "fuzzy") == 0);
+    session_close(&ss);
+    return (status == 0 ? 0 : 1);
 }
 
+if (store_open(&st, STORE_FILE, WAL_FILE,
+               importing && argc > 3 ? atoi(argv[3]) : DEFAULT_BATCH,
+               importing && argc > 4 ? atol(argv[4]) : DEFAULT_DELAY_MS) != 0)
+    return (1);
+
+if (importing)
+    status = import_registrations(&st, argv[2]);
+else if (argc > 2 && strcmp(argv[1], "delete") == 0)
+    status = delete_registration(&st, strtoul(argv[2], NULL, 10));
+else
+    status = register_users(&st);
+
+if (store_close(&st) != 0)
+    status = -1;
+return (status == 0 ? 0 : 1);
+}